@@ -9,31 +9,72 @@
 #ifndef BUF_H
 #define BUF_H
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <vector>
 #include "db.h"
+#include "replacer.h"
+#include "ioPool.h"
+#include "ioEngine.h"
+#include "compTier.h"
 // define if debug output wanted
 //#define DEBUGBUF
 
-// declarations for buffer pool hash table
+// declarations for buffer pool hash table.  Buckets are stored inline
+// in the table (no per-entry allocation).
 struct hashBucket
 {
-	File*	file;    // pointer a file object (more on this below)
+	const File*	file;    // pointer a file object (more on this below)
 	int	pageNo;  // page number within a file
 	int	frameNo; // frame number of page in the buffer pool
-	hashBucket* 	next;	 // next node in the hash table
 };
 
+// buckets in each cache line of the hash table
+const int HTLINESLOTS = 3;
 
-// hash table to keep track of pages in the buffer pool
+// one cache line of the hash table: a spin lock, three buckets and a
+// count of the entries that had to go past it.  A page is looked for in
+// its home line first, so a hit there locks, reads and unlocks this one
+// line and nothing else.
+struct alignas(64) hashLine
+{
+	std::atomic<bool> busy;  // held while the line is read or changed
+	unsigned char	used;    // bit i set if slots[i] holds an entry
+	unsigned int	spill;   // entries homed at or before this line that
+	                         // are stored after it; 0 ends a lookup here
+	hashBucket	slots[HTLINESLOTS];
+
+	hashLine() : busy(false), used(0), spill(0) {}
+	void lock();
+	void unlock() { busy.store(false, std::memory_order_release); }
+};
+
+// hash table to keep track of pages in the buffer pool: a power-of-two
+// array of cache lines, each with a lock of its own, probed linearly a
+// line at a time.  An entry goes in the first line from its home that
+// has a free bucket and stays there until it is removed; each full line
+// it passes counts it in spill, so a miss stops at the first line nothing
+// went past.  Deleting clears the bucket and the counts on the way to
+// it: no tombstones, and no entry ever moves, so a lookup only needs one
+// line locked at a time.  A writer that has to go past its home line
+// holds spillLock as well, so it is the only thread holding more than
+// one line.
 class BufHashTbl
 {
 private:
-    int HTSIZE;
-    hashBucket**  ht; // actual hash table
-    int	 hash(const File* file, const int pageNo); // returns value between 0 and HTSIZE-1
+    hashLine*     lines;     // mask+1 lines
+    unsigned int  mask;      // number of lines - 1
+    std::mutex    spillLock; // held by writers that go past their home line
+    unsigned long hash(const File* file, const int pageNo); // 64-bit mixed hash of (file,pageNo)
 
 public:
     BufHashTbl(const int htSize);  // constructor
     ~BufHashTbl(); // destructor
+
+    // rebuild for a new htSize; nothing else may use the table meanwhile
+  void resize(const int htSize);
 	
     // insert entry into hash table mapping (file,pageNo) to frameNo;
     // returns 0 if OK, HASHTBLERROR if an error occurred
@@ -44,6 +85,10 @@ public:
     // HASHNOTFOUND
   Status lookup(const File* file, const int pageNo, int & frameNo);
 
+    // look up count pages of file at once; frameNos[i] is -1 where
+    // pageNos[i] is not in the pool
+  void lookup(const File* file, const int pageNos[], const int count, int frameNos[]);
+
     // delete entry (file,pageNo) from hash table. REturn OK if page was
     // found.  Else return HASHTBLERROR
   Status remove(const File* file, const int pageNo);  
@@ -52,52 +97,108 @@ public:
 
 class BufMgr;  //forward declaration of BufMgr class 
 
-// class for maintaining information about buffer pool frames
+// class for maintaining information about buffer pool frames.
+// file, pageNo, dirty and valid are protected by latch; pinCnt only
+// changes under the latch but may be read without it.  Set() and Clear()
+// also keep the file's index of its resident pages up to date.
 class BufDesc {
     friend class BufMgr;
 private:
   File* file;   // pointer to file object
   int   pageNo; // page within file
   int	frameNo;  // frame # of frame
-  int   pinCnt; // number of times this page has been pinned
+  std::atomic<int>  pinCnt; // number of times this page has been pinned
   bool 	dirty;	  // true if dirty;  false otherwise
   bool 	valid;   // true if page is valid
-  bool  refbit;	 // has this buffer frame been reference recently
+  bool	prefetched; // read ahead and not yet requested by anyone
+  bool	dropBehind; // first requested after readahead and not since
+  Page*	home;     // the frame's own slot in its arena
+  Page*	page;     // where the page lives: home, or the mapping of a mapped file
+  std::mutex latch;  // held while the frame's identity or contents change
+
+  BufDesc* fileNext;  // next and previous frame of the same file,
+  BufDesc* filePrev;  // guarded by the file's residentLock
 
   void Clear() {  // initialize buffer frame for a new user
+	if (file != NULL) {  // unlink from the file's resident frames
+	    std::lock_guard<std::mutex> guard(file->residentLock);
+	    if (filePrev != NULL) filePrev->fileNext = fileNext;
+	    else file->resident = fileNext;
+	    if (fileNext != NULL) fileNext->filePrev = filePrev;
+	}
     	pinCnt = 0;
+	page = home;
 	file = NULL;
 	pageNo = -1;
     	dirty = false;
 	valid = false;
+	prefetched = false;
+	dropBehind = false;
   };
 
   void Set(File* filePtr, int pageNum) { 
       file = filePtr;
       pageNo = pageNum;
+      {
+          std::lock_guard<std::mutex> guard(filePtr->residentLock);
+          filePrev = NULL;
+          fileNext = filePtr->resident;
+          if (fileNext != NULL) fileNext->filePrev = this;
+          filePtr->resident = this;
+      }
+      page = filePtr->mappedPage(pageNum);  // a mapped page is used in place
+      if (page == NULL) page = home;
       pinCnt = 1;
       dirty = false;
       valid = true;
-      refbit = true;
+      prefetched = false;
+      dropBehind = false;
   }
 
   BufDesc() {
+      home = NULL;
+      file = NULL;
+      fileNext = filePrev = NULL;
       Clear();
   }
 };
 
 
+// counters the pool keeps, indexes into BufMgr::counters
+enum BufCounter {
+  STAT_ACCESSES, STAT_HITS, STAT_DISKREADS, STAT_DISKWRITES,
+  STAT_PREFETCHED, STAT_PREFETCHHITS, STAT_PREFETCHUNUSED,
+  STAT_BGWRITES, STAT_WRITESTALLS, STAT_EVICTCLEAN, STAT_EVICTDIRTY,
+  STAT_SWEEPS, STAT_PINWAITS, STAT_EXCEEDED, NUMBUFCOUNTERS
+};
+
+// The pool's statistics as read at one moment.  Counters are 64-bit;
+// subtracting an earlier snapshot gives the activity in between.
 struct BufStats
 {
-  int accesses;    // Total number of accesses to buffer pool
-  int diskreads;   // Number of pages read from disk (including allocs)
-  int diskwrites;  // Number of pages written back to disk
+  unsigned long accesses;    // Total number of accesses to buffer pool
+  unsigned long hits;        // Accesses that found the page in the pool
+  unsigned long diskreads;   // Number of pages read from disk (including allocs)
+  unsigned long diskwrites;  // Number of pages written back to disk
+  unsigned long prefetched;  // Pages read ahead of any request (also in diskreads)
+  unsigned long prefetchHits;   // Prefetched pages later requested by readPage
+  unsigned long prefetchUnused; // Prefetched pages dropped before being requested
+  unsigned long bgwrites;    // Pages written by the background writer (also in diskwrites)
+  unsigned long writeStalls; // Evictions that had to write a dirty victim themselves
+  unsigned long evictClean;  // Evictions of clean pages
+  unsigned long evictDirty;  // Evictions that wrote the page out first
+  unsigned long sweeps;      // Frames asked of the replacement policy
+  unsigned long sweepSteps;  // Frames the policy looked at to find them
+  unsigned long pinWaits;    // Pins that had to wait for the frame's latch
+  unsigned long bufferExceeded; // Requests refused because every frame was pinned
+  LatencyHist readLatency;   // File reads issued by this pool, per call
+  LatencyHist writeLatency;  // File writes issued by this pool, per call
+  TierStats tier;            // the compressed tier, if one is set up
+
+  void clear();
+  BufStats operator - (const BufStats& earlier) const;
+  void print(ostream& os, const bool json = false) const;
 
-  void clear()
-    {
-      accesses = diskreads = diskwrites = 0;
-    }
-      
   BufStats()
     {
       clear();
@@ -105,45 +206,282 @@ struct BufStats
 };
 
 
+// number of background threads that perform prefetch reads
+const int IOTHREADS = 2;
+
+// most pages read ahead of a sequential reader at a time
+const int RAWINDOW = 32;
+
+// consecutive page numbers after which a reader counts as sequential
+const int SEQRUN = 3;
+
+// per-file sequential access detector used for readahead
+struct SeqState
+{
+  const File* file;   // file the entry describes, NULL if unused
+  int lastPage;       // last page the reader missed on or first hit after prefetch
+  int run;            // length of the ascending run ending at lastPage
+  int raEnd;          // one past the last page already read ahead
+};
+
+const int SEQSLOTS = 16;  // files tracked at once
+
+
+// most consecutive pages written back with one call; a flush holds the
+// latches of that many frames at once
+const int FLUSHRUN = 32;
+
+// a page to write back, as seen when the flush was planned
+struct FlushEntry
+{
+  File* file;
+  int   pageNo;
+  int   frameNo;
+};
+
+// what writing back a set of pages is for
+enum FlushMode {
+  FLUSH_DROP,        // flushFile: write dirty pages, then empty their frames;
+                     // pinned pages are skipped and left in the pool
+  FLUSH_CHECKPOINT,  // flushAll: write dirty pages and keep them; pinned or
+                     // latched pages are skipped rather than waited for
+  FLUSH_CLOSE        // ~BufMgr: write every dirty page, pinned or not
+};
+
+
+// A pin on one page of the pool, dropped when the handle is destroyed,
+// released or assigned another page.  The handle remembers the frame, so
+// dropping the pin needs no hash lookup.  Handles move but do not copy,
+// and must not outlive the BufMgr that filled them in.  A caller that
+// changed the page calls markDirty() before the pin is dropped.
+class PageHandle
+{
+    friend class BufMgr;
+private:
+  BufMgr* mgr;      // pool the pin belongs to, NULL if the handle is empty
+  int     frameNo;  // frame holding the page
+  Page*   page;     // the pinned page
+  bool    dirty;    // unpin as dirty
+
+  void attach(BufMgr* owner, const int frame, Page* pagePtr);
+
+public:
+  PageHandle() : mgr(NULL), frameNo(-1), page(NULL), dirty(false) {}
+  PageHandle(PageHandle&& other)
+    : mgr(other.mgr), frameNo(other.frameNo), page(other.page), dirty(other.dirty)
+  {
+      other.mgr = NULL;
+      other.frameNo = -1;
+      other.page = NULL;
+      other.dirty = false;
+  }
+  PageHandle& operator = (PageHandle&& other)
+  {
+      if (this != &other) {
+          release();
+          mgr = other.mgr;
+          frameNo = other.frameNo;
+          page = other.page;
+          dirty = other.dirty;
+          other.mgr = NULL;
+          other.frameNo = -1;
+          other.page = NULL;
+          other.dirty = false;
+      }
+      return *this;
+  }
+  PageHandle(const PageHandle&) = delete;
+  PageHandle& operator = (const PageHandle&) = delete;
+  ~PageHandle() { release(); }
+
+  Page* get() const { return page; }
+  Page* operator -> () const { return page; }
+  bool  pinned() const { return mgr != NULL; }
+  int   frame() const { return frameNo; }
+  void  markDirty() { dirty = true; }
+  const Status release();   // drop the pin now; OK if there is none
+};
+
+
+// Keeps calls on a pool out while BufMgr::resize() swaps the pool's
+// tables.  Each call counts itself in on a per-thread shard, so getting
+// through the gate costs one uncontended atomic add, as for the
+// statistics; close() waits until every shard is empty.
+class PoolGate
+{
+private:
+  struct alignas(64) Shard
+  {
+    std::atomic<int> inside;  // calls in progress that counted in here
+  };
+
+  Shard shards[STATSHARDS];
+  std::atomic<bool> closed;
+  std::mutex lock;
+  std::condition_variable reopened;
+
+public:
+  PoolGate();
+
+  void enter();   // wait while the gate is closed, then count in
+  void leave();
+  void close();   // keep new calls out and wait for those inside to leave
+  void open();
+};
+
+
+// frames per block of frame descriptors.  The descriptors are allocated
+// a block at a time as the pool grows, so a descriptor never moves.
+const int DESCBLOCKBITS = 10;
+const int DESCBLOCK = 1 << DESCBLOCKBITS;
+
+// one allocation of page frames: the whole pool at first, then whatever
+// resize() adds
+struct PoolArena
+{
+  Page*  base;        // page of the first frame
+  int    firstFrame;
+  int    frames;      // frames the arena has room for
+  size_t bytes;       // size of the allocation
+  bool   mapped;      // came from mmap rather than posix_memalign
+};
+
+
+// The buffer manager may be shared by several threads.  A hit only
+// takes one hash line lock and the latch of the frame it pins, so
+// hits on different pages do not contend with each other.
 class BufMgr 
 {
+    friend class PageHandle;
 private:
-  unsigned int 	 clockHand;
-  int   	 numBufs;    	// Number of pages in buffer pool
+  std::atomic<int> numBufs;	// Number of pages in buffer pool
   BufHashTbl*    hashTable;  	// hash table mapping (File, page) to frame
-  BufDesc*	 bufTable;  	// vector of status info, 1 per page
-  BufStats	 bufStats;	// buffer pool statistics
+  vector<BufDesc*> descBlocks;	// status info, 1 per page, DESCBLOCK per block
+  vector<PoolArena> arenas;	// the memory of the frames, in frame order
+  ShardedCounters<NUMBUFCOUNTERS> counters; // buffer pool statistics
+  unsigned long	 sweptBase;	// replacer->swept() when the counters were cleared
+  IOStats	 ioStats;	// latency of the disk I/O this pool issues
+  Replacer*	 replacer;	// chooses which unpinned frame to evict
+  int*		 freeList;	// frames holding no page, used before evicting
+  int		 numFree;	// number of entries on freeList
+  std::mutex	 freeLock;	// guards freeList
+  IOPool*	 ioPool;	// background threads for prefetch reads
+  int		 raWindow;	// pages to keep read ahead of a sequential reader
+  SeqState	 seqTable[SEQSLOTS]; // readahead state, hashed by file
+  std::mutex	 seqLock;	// guards seqTable
+
+  std::thread	 bgWriter;	// background writer, if started
+  std::mutex	 bgLock;	// guards the bg* settings below
+  std::condition_variable bgWake; // wakes the writer early or for shutdown
+  bool		 bgStop;	// writer should exit
+  int		 bgCleanTarget;	// clean candidates to keep ahead of eviction
+  int		 bgMaxWrites;	// most pages written per round
+  int		 bgInterval;	// milliseconds between rounds
+  int*		 bgCandidates;	// scratch space for the writer's lookahead
+  string	 manifestPath;	// manifest kept up to date by setManifest(), "" if none
+  int		 manifestInterval; // milliseconds between saves by the writer, 0 if none
+  CompressedTier* tier;		// evicted clean pages, compressed; NULL if off
+
+  mutable PoolGate gate;	// closed by resize() and setTierBudget() while they swap tables
+  std::mutex	 resizeLock;	// one resize() or setTierBudget() at a time
+  std::atomic<int> frameLimit;	// frames at or above it are being drained
+  std::atomic<int> budgetFrames;	// frames the memory budget allows, 0 if none
+
+  const Status allocBuf(int & frame);   // allocate a free frame, returned latched
+  const Status allocBufs(const int count, int frames[], int & claimed);
+                        // allocate up to count frames, returned pinned and unlatched
+  const Status evictFrame(const int frame); // empty a frame the policy offered
+  const void releaseBuf(int frame); // return unused (latched) frame to the pool
+  void pushFree(const int frame);  // put an emptied frame on the free list
+  bool popFree(int & frame);       // take a frame off the free list, if any
+  void readAhead(File* file, const int pageNo); // note an access, prefetch if sequential
+  int  readerPosition(const File* file); // where a sequential reader of file is
+  void prefetchPages(File* file, const int pageNo, const int count, const bool ahead);
+                        // runs on ioPool
+  bool prefetchRun(File* file, const int firstPage, const int count, const bool ahead);
+  bool pinResident(File* file, const int PageNo, const int frameNo); // hit path of readPage
+  bool loadFromTier(File* file, const int PageNo, BufDesc* frame); // miss served by the tier
+  const Status pin(File* file, const int PageNo, int& frameNo);      // readPage by frame
+  const Status pinPages(File* file, const int pageNos[], const int count, int frames[]);
+  const Status loadPages(File* file, const int pageNos[], int missing[], const int count,
+                         int frames[]);   // miss path of pinPages
+  const Status unpinFrame(const int frameNo, const bool dirty); // unPinPage by frame
+  const Status writeBack(vector<FlushEntry>& pages, const FlushMode mode, int& skipped);
+                        // write pages back in file and page order
+  const Status writeRun(FlushEntry run[], const int count, const FlushMode mode, int& skipped);
+                        // one run of consecutive pages of writeBack
 
-  const Status allocBuf(int & frame);   // allocate a free frame.  
-  const void releaseBuf(int frame); // return unused frame to end of list
-  void advanceClock()
+  BufDesc& desc(const int frame)   // descriptor of a frame
   {
-	clockHand = (clockHand + 1) % numBufs;
+	return descBlocks[frame >> DESCBLOCKBITS][frame & (DESCBLOCK - 1)];
   }
+  PoolArena allocArena(const int bufs);
+  void   freeArena(const PoolArena& arena);
+  void   addFrames(const int bufs);       // add frames numBufs.. to the tables
+  const Status grow(const int newFrames);
+  const Status shrink(const int newFrames, const int waitMs);
+  const Status retireFrame(const int frame); // empty a frame being drained
+  void bgWriterLoop();  // body of the background writer thread
+  void cleanAhead();    // one round of the background writer
 
 
 public:
-  Page*	         bufPool;   // actual buffer pool
+  Page*	         bufPool;   // actual buffer pool (its first arena)
 
-  BufMgr(const int bufs);
+  BufMgr(const int bufs, const ReplPolicy policy = CLOCK);
   ~BufMgr();
 
   const Status readPage(File* file, const int PageNo, Page*& page);
+  const Status readPage(File* file, const int PageNo, PageHandle& handle);
+                        // pin a page for as long as handle holds it
+  const Status readPages(File* file, const int pageNos[], const int count, Page* pages[]);
+  const Status readPages(File* file, const int pageNos[], const int count,
+                         PageHandle handles[]); // pin several pages at once
   const Status unPinPage(File* file, const int PageNo, const bool dirty);
+  const Status unpinPages(File* file, const int pageNos[], const int count, const bool dirty);
   const Status allocPage(File* file, int& PageNo, Page*& page); 
                         // allocates a new, empty page 
-  const Status flushFile(const File* file); // writing out all dirty pages of the file
+  const Status allocPages(File* file, const int count, int& firstPageNo, Page* pages[]);
+                        // allocates count consecutive new pages, all pinned
+  const Status flushFile(const File* file, const bool sync = false);
+                        // write out all dirty pages of the file and drop its pages
+  const Status flushAll(int& skipped, const bool sync = false);
+                        // checkpoint: write out every dirty page not in use
   const Status disposePage(File* file, const int PageNo); // dispose of page in file
-  void  printSelf();
+  const Status prefetch(File* file, const int PageNo, const int count = 1);
+                        // start reading pages in the background
+  const Status startBgWriter(const int cleanTarget, const int maxWrites = 64,
+                             const int intervalMs = 50);
+                        // keep cleanTarget clean frames ready for eviction
+  void  stopBgWriter(); // stop the background writer, if running
+  const Status resize(const int newFrames, const int waitMs = 0);
+                        // grow or shrink the pool while it is in use
+  const Status setMemoryBudget(const size_t bytes, const int waitMs = 0);
+                        // size the pool to bytes of memory, and keep
+                        // shrinking it towards that if pages were pinned
+  int   numFrames() const { return numBufs; }
+  const Status saveManifest(const string& path);
+                        // list the pages in the pool, hottest first
+  void  setManifest(const string& path, const int intervalMs = 0);
+                        // save the manifest on shutdown, and every intervalMs
+                        // while the background writer runs; "" stops it
+  const Status warmUp(const string& path, File* const files[], const int count, int& pages);
+                        // read the pages a manifest lists back into the pool
+                        // in the background
+  void  setTierBudget(const size_t bytes);
+                        // keep evicted clean pages compressed in up to
+                        // bytes of memory; 0 turns the tier off
+  void  printSelf(ostream& os = cout, const bool json = false);
+                        // dump the statistics, the files in the pool and
+                        // (as text) every frame
 
-  const BufStats & getBufStats() const // get buffer pool usage
+  const char* policyName() const // name of the replacement policy in use
   {
-	return bufStats;
-  }
-  const void clearBufStats() 
-  {
-	bufStats.clear();
+	return replacer->name();
   }
+
+  BufStats getBufStats() const; // snapshot of buffer pool usage
+  const void clearBufStats();   // zero the pool's counters and the I/O histograms
 };
 
 #endif
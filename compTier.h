@@ -0,0 +1,90 @@
+/**
+* Thomas Smegal, student ID: 9083224718
+* Arjun Muralikrishnan, student ID: 9082992190
+* Omkar Kendale, student ID: 9084295774
+*
+* This header defines the compressed page tier: a second level of cache
+* below the buffer pool that keeps clean pages evicted from the pool in
+* compressed form, within a memory budget, so a later miss on them can be
+* served without going to disk. Pages are compressed with a small built-in
+* LZ codec, or with zlib when built with -DHAVE_ZLIB.
+*/
+#ifndef COMPTIER_H
+#define COMPTIER_H
+
+#include <mutex>
+#include <list>
+#include <unordered_map>
+#include "page.h"
+#include "replacer.h"
+
+// a page is only kept if it compresses to at most this fraction of its size
+const double TIERMAXRATIO = 0.75;
+
+// bytes charged per page kept, on top of its compressed size, for the
+// map and list entries that track it
+const size_t TIERENTRYBYTES = 64;
+
+// codec used by the tier, exposed for tests and benchmarks.  compressPage
+// returns the compressed length, or 0 if the page does not fit in cap
+// bytes; expandPage returns false if the data does not decode to a page.
+size_t compressPage(const Page* page, unsigned char* dst, const size_t cap);
+bool   expandPage(const unsigned char* src, const size_t len, Page* page);
+const char* tierCodecName();
+
+// the tier's own counters; pages and bytes describe its contents now
+struct TierStats
+{
+  unsigned long hits;     // misses of the pool served from the tier
+  unsigned long misses;   // misses of the pool the tier could not serve
+  unsigned long stored;   // pages put in the tier
+  unsigned long rejected; // pages that did not compress well enough
+  unsigned long evicted;  // pages dropped to stay within the budget
+  unsigned long pages;    // pages in the tier
+  unsigned long bytes;    // memory charged to them
+
+  TierStats() : hits(0), misses(0), stored(0), rejected(0), evicted(0), pages(0), bytes(0) {}
+};
+
+// The tier is exclusive with the pool: a page is taken out when the pool
+// reads it back, so it is never in both.  Only clean pages are put in, so
+// the copy on disk is always as new as the one in the tier.  Pages are
+// compressed and expanded outside the lock, which guards only the map.
+class CompressedTier
+{
+private:
+  struct Entry
+  {
+    unsigned char* data;              // compressed page
+    size_t         len;
+    list<PageKey>::iterator age;      // position in lru
+  };
+
+  std::mutex lock;
+  unordered_map<PageKey, Entry, PageKeyHash> entries;
+  list<PageKey> lru;                  // least recently stored first
+  size_t budget;                      // most bytes the tier may hold
+  TierStats stats;
+
+  void drop(unordered_map<PageKey, Entry, PageKeyHash>::iterator it); // lock held
+
+public:
+  CompressedTier(const size_t budgetBytes);
+  ~CompressedTier();
+
+  // keep a compressed copy of a clean page, replacing any older one
+  void put(const File* file, const int pageNo, const Page* page);
+
+  // if the tier has the page, expand it into page and forget it
+  bool take(const File* file, const int pageNo, Page* page);
+
+  bool contains(const File* file, const int pageNo); // is the page kept
+  void erase(const File* file, const int pageNo); // forget a page, if kept
+  void eraseFile(const File* file);     // forget every page of file
+  void setBudget(const size_t budgetBytes); // shrinking drops the oldest pages
+
+  TierStats getStats();
+  void clearStats();                    // zero the counters, not pages/bytes
+};
+
+#endif
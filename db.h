@@ -10,7 +10,10 @@
 
 #include <sys/types.h>
 #include <functional>
+#include <atomic>
+#include <mutex>
 #include "error.h"
+#include "stats.h"
 #include <string.h>
 using namespace std;
 
@@ -19,23 +22,72 @@ using namespace std;
 //#define DEBUGIO
 //#define DEBUGFREE
 
+// structure of DB (header) page
+
+typedef struct {
+  int nextFree;                         // page # of next page on free list
+  int firstPage;                        // page # of first page in file
+  int numPages;                         // total # of pages in file
+} DBPage;
+
+// A file opened in mapped mode is mmap'ed in segments of MAPSEGPAGES
+// pages, each mapped the first time one of its pages is used.  Segments
+// never move, so page pointers into the mapping stay valid until the file
+// is closed; growing the file just makes more of the last segment usable
+// or maps a new one.  Pages past MAXMAPSEGS segments are read and written
+// the ordinary way.
+
+const int MAPSEGPAGES = 1024;
+const int MAXMAPSEGS = 4096;
+
+// what the buffer manager and the disk did for one file, as read at one
+// moment; subtract two of them for the activity in between
+struct FileStats
+{
+  unsigned long hits;      // requests for its pages found in the pool
+  unsigned long misses;    // requests that had to read the page in
+  unsigned long reads;     // pages read from disk (mapped pages excluded)
+  unsigned long writes;    // pages written to disk
+
+  FileStats() : hits(0), misses(0), reads(0), writes(0) {}
+  FileStats operator - (const FileStats& earlier) const;
+};
+
+// counters a File keeps, indexes into File::counters
+enum FileCounter { FSTAT_HITS, FSTAT_MISSES, FSTAT_READS, FSTAT_WRITES, NUMFILECOUNTERS };
+
 // forward class definition for db
 class DB;
+class BufDesc;
 
 // class definition for open files
 class File {
   friend class DB;
   friend class OpenFileHashTbl;
+  friend class BufMgr;
+  friend class BufDesc;
 
  public:
 
   Status allocatePage(int& pageNo);     // allocate a new page
+  const Status allocatePages(const int count,
+                             int& firstPageNo); // allocate consecutive new pages
   const Status disposePage(const int pageNo);       // release space for a page
   const Status readPage(const int pageNo,
 		  Page* pagePtr) const;       // read page from file
   const Status writePage(const int pageNo,
 		   const Page* pagePtr);      // write page to file
+  const Status readPages(const int pageNo, const int count,
+		  Page* const pages[]) const; // read consecutive pages
+  const Status writePages(const int pageNo, const int count,
+		   const Page* const pages[]);// write consecutive pages
   const Status getFirstPage(int& pageNo) const;     // returns pageNo of first page
+  const Status flushHeader() const;     // write the cached header page back
+  const Status sync() const;            // header and written pages on disk (fdatasync)
+  Page* mappedPage(const int pageNo);   // page's address in the mapping, NULL if none
+  bool isMapped() const { return mapped; }
+  const string& name() const { return fileName; }
+  FileStats getStats() const;           // this file's counters
 
   bool operator == (const File & other) const
     {
@@ -50,8 +102,12 @@ class File {
   static const Status create(const string &fileName);
   static const Status destroy(const string &fileName);
 
-  const Status open();
+  const Status open(const bool map);
   const Status close();
+  void unmap();
+  bool inMapping(const int pageNo, const Page* pagePtr) const;
+  const Status syncMapped(const int pageNo, const int count); // write back mapped pages
+  const Status extend(const int count, int& firstPageNo);     // grow the file, hdrLock held
 
   const Status intread(const int pageNo,
 		 Page* pagePtr) const;        // internal file read
@@ -65,6 +121,17 @@ class File {
   string fileName;                    // The name of the file
   int openCnt;                        // # times file has been opened
   int unixFile;                       // unix file stream for file
+  mutable std::mutex hdrLock;         // guards the cached header
+  mutable DBPage hdr;                 // header page, read on open, written back lazily
+  mutable bool hdrDirty;              // hdr differs from the header on disk
+  bool mapped;                        // pages are accessed through mmap
+  std::atomic<int> mapLimit;          // pages in the file, as far as the mapping knows
+  std::atomic<char*>* mapSegs;        // segment addresses, NULL until mapped
+  std::mutex mapLock;                 // serializes mapping new segments
+  mutable ShardedCounters<NUMFILECOUNTERS> counters; // hits and misses (kept by BufMgr), I/O
+  mutable std::mutex residentLock;    // guards resident and its links
+  mutable BufDesc* resident;          // frames holding its pages in the buffer pool,
+                                      // linked through BufDesc by Set() and Clear()
 };
 
 class BufMgr;
@@ -113,20 +180,14 @@ class DB {
   const Status createFile(const string & fileName) ;  // create a new file
   const Status destroyFile(const string & fileName) ; // destroy a file, 
                                                            // release all space
-  const Status openFile(const string & fileName, File* & file);  // open a file
-  const Status closeFile(File* file);         // close a file
+  const Status openFile(const string & fileName, File* & file,
+                        const bool mapped = false);  // open a file
+  const Status closeFile(File* file);         // close a file; left open,
+                                              // with PAGEPINNED, while a
+                                              // page of it is pinned
 
  private:
   OpenFileHashTbl   openFiles;    // list of open files
 };
 
-
-// structure of DB (header) page
-
-typedef struct {
-  int nextFree;                         // page # of next page on free list
-  int firstPage;                        // page # of first page in file
-  int numPages;                         // total # of pages in file
-} DBPage;
-
 #endif
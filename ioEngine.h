@@ -0,0 +1,66 @@
+/**
+* Thomas Smegal, student ID: 9083224718
+* Arjun Muralikrishnan, student ID: 9082992190
+* Omkar Kendale, student ID: 9084295774
+*
+* This header defines the engine File uses to move pages between memory and
+* disk. All transfers are positional, so several threads may do I/O on the
+* same file at once. The backend is chosen at build time: POSIX pread/pwrite
+* and preadv/pwritev by default, or io_uring when compiled with -DUSE_IOURING
+* (see the uring target in the makefile).
+*/
+#ifndef IOENGINE_H
+#define IOENGINE_H
+
+#include "error.h"
+
+class Page;
+
+// one page of a batched transfer
+struct PageIO
+{
+  int   pageNo;   // page number within the file
+  Page* page;     // memory the page is read into or written from
+};
+
+// largest number of pages moved by one vectored system call
+const int IOVMAX = 64;
+
+class IOEngine
+{
+public:
+  static IOEngine& instance();   // the engine this build was compiled with
+  virtual ~IOEngine() {}
+
+  virtual const char* name() const = 0;
+
+  // transfer a single page
+  virtual const Status read(const int fd, const int pageNo, Page* page) = 0;
+  virtual const Status write(const int fd, const int pageNo, const Page* page) = 0;
+
+  // transfer count consecutive pages starting at pageNo
+  virtual const Status readv(const int fd, const int pageNo, Page* const pages[], const int count) = 0;
+  virtual const Status writev(const int fd, const int pageNo, const Page* const pages[], const int count) = 0;
+
+  // transfer a batch of pages in any order.  Runs of entries for
+  // consecutive pages go out as one vectored request, and the io_uring
+  // engine keeps all requests of the batch in flight at once.
+  virtual const Status readBatch(const int fd, const PageIO ios[], const int count) = 0;
+  virtual const Status writeBatch(const int fd, const PageIO ios[], const int count) = 0;
+};
+
+
+// pread/pwrite and preadv/pwritev
+class PosixEngine : public IOEngine
+{
+public:
+  const char* name() const { return "posix"; }
+  const Status read(const int fd, const int pageNo, Page* page);
+  const Status write(const int fd, const int pageNo, const Page* page);
+  const Status readv(const int fd, const int pageNo, Page* const pages[], const int count);
+  const Status writev(const int fd, const int pageNo, const Page* const pages[], const int count);
+  const Status readBatch(const int fd, const PageIO ios[], const int count);
+  const Status writeBatch(const int fd, const PageIO ios[], const int count);
+};
+
+#endif
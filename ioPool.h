@@ -0,0 +1,49 @@
+/**
+* Thomas Smegal, student ID: 9083224718
+* Arjun Muralikrishnan, student ID: 9082992190
+* Omkar Kendale, student ID: 9084295774
+*
+* This header defines a small pool of background threads the buffer manager
+* hands disk reads to, so that prefetching does not block the caller. Each
+* job names an owner (the file it reads), so the jobs of one file can be
+* called off without waiting for those of the others.
+*/
+#ifndef IOPOOL_H
+#define IOPOOL_H
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <functional>
+
+class IOPool
+{
+private:
+  std::mutex lock;
+  std::condition_variable work;   // signalled when a job is queued or on shutdown
+  std::condition_variable idle;   // signalled when a job finishes
+  struct Job
+  {
+    const void* owner;
+    std::function<void()> run;
+  };
+  std::deque<Job> jobs;
+  std::vector<std::thread> threads;
+  std::vector<const void*> running;   // owners of the jobs running now
+  bool stopping;
+
+  void run();      // body of each worker thread
+
+public:
+  IOPool(const int numThreads);
+  ~IOPool();       // finishes the queued jobs, then joins the workers
+
+  // queue job for a worker
+  void submit(const void* owner, const std::function<void()>& job);
+  // drop the queued jobs of owner and wait for its running ones to finish
+  void cancel(const void* owner);
+};
+
+#endif
@@ -8,6 +8,7 @@
 #ifndef PAGE_H
 #define PAGE_H
 
+#include <type_traits>
 #include "error.h"
 #include "string.h"
 
@@ -24,42 +25,74 @@ struct Record
   int length;
 };
 
+// page size in bytes, fixed at compile time (make PAGESIZE=8192).  Any
+// power of two from 1K to 64K works; files are only readable by a build
+// with the page size they were written with.
+#ifndef DBPAGESIZE
+#define DBPAGESIZE 1024
+#endif
+
+const unsigned PAGESIZE = DBPAGESIZE;
+static_assert(PAGESIZE >= 1024 && PAGESIZE <= 65536 && (PAGESIZE & (PAGESIZE - 1)) == 0,
+              "DBPAGESIZE must be a power of two from 1024 to 65536");
+
+// offsets and lengths within a page: short while they fit, so the
+// layout of 1K pages is unchanged, int for pages of 64K
+typedef std::conditional<PAGESIZE <= 32768, short, int>::type slotoff_t;
+
 // slot structure
 struct slot_t {
-        short	offset;  
-        short	length;  // equals -1 if slot is not in use
+        slotoff_t	offset;  
+        slotoff_t	length;  // equals -1 if slot is not in use
 };
 
-const unsigned PAGESIZE = 1024;
-const unsigned DPFIXED= sizeof(slot_t)+4*sizeof(short)+2*sizeof(int);
+const unsigned DPFIXED= sizeof(slot_t)+4*sizeof(slotoff_t)+2*sizeof(int);
 const unsigned PAGEDATASIZE = PAGESIZE-DPFIXED+sizeof(slot_t);
 // size of the data area of a page
 
+// Pages are aligned so a page in memory can be the buffer of an O_DIRECT
+// transfer, which needs at most 4K alignment.
+const unsigned PAGEALIGN = PAGESIZE < 4096 ? PAGESIZE : 4096;
+
 // Class definition for a minirel data page.   
-// The design assumes that records are kept compacted when
-// deletions are performed. Notice, however, that the slot
+// Deleting a record leaves a hole in data[]; the records are
+// compacted only when an insert needs more contiguous space than
+// is left after freePtr. Notice, however, that the slot
 // array cannot be compacted.  Notice, this class does not keep
 // the records align, relying instead on upper levels to take
 // care of non-aligned attributes
 
-class Page {
+class alignas(PAGEALIGN) Page {
 private:
     char 	data[PAGESIZE - DPFIXED]; 
     slot_t 	slot[1]; // first element of slot array - grows backwards!
-    short	slotCnt; // number of slots in use;
-    short	freePtr; // offset of first free byte in data[]
-    short	freeSpace; // number of bytes free in data[]
-    short	dummy;	// for alignment purposes
+    slotoff_t	slotCnt; // number of slots in use;
+    slotoff_t	freePtr; // offset of first free byte in data[]
+    slotoff_t	freeSpace; // number of bytes free in data[]
+    slotoff_t	freeHint; // lowest empty slot, or the number of slots if none.
+                          // Pages from older builds may hold anything here,
+                          // so it is checked before it is trusted
     int		nextPage; // forwards pointer
     int		curPage;  // page number of current pointer
 
+    // The slot array, addressed from the start of the page so indexing it
+    // with negative slot numbers stays inside the object.
+    slot_t* slots()
+      { return (slot_t*)((char*)this + PAGESIZE - DPFIXED); }
+    const slot_t* slots() const
+      { return (const slot_t*)((const char*)this + PAGESIZE - DPFIXED); }
+
+    int  findFreeSlot() const;       // lowest empty slot, -slotCnt if none
+    int  nextLive(int i) const;      // first used slot at or after i
+    void compact();                  // squeeze the holes out of data[]
+
 public:
     void init(const int pageNo); // initialize a new page
     void dumpPage() const;       // dump contents of a page
 
     const Status getNextPage(int& pageNo) const; // returns value of nextPage
     const Status setNextPage(const int pageNo); // sets value of nextPage to pageNo
-    const short getFreeSpace() const; // returns amount of free space
+    const slotoff_t getFreeSpace() const; // returns amount of free space
 
     // inserts a new record (rec) into the page, returns RID of record 
     const Status insertRecord(const Record & rec, RID& rid);
@@ -67,6 +100,16 @@ public:
     // delete the record with the specified rid
     const Status deleteRecord(const RID & rid);
 
+    // insert count records, stopping at the first that does not fit;
+    // inserted says how many went in. Returns NOSPACE if not all did.
+    const Status insertRecords(const Record recs[], const int count,
+                               RID rids[], int& inserted);
+
+    // delete count records. Every rid is checked before any is deleted;
+    // returns INVALIDSLOTNO (deleting nothing) if one is not in use or
+    // is listed twice.
+    const Status deleteRecords(const RID rids[], const int count);
+
     // returns RID of first record on page
     // returns  NORECORDS if page contains no records.  Otherwise, returns OK
     const Status firstRecord(RID& firstRid) const;
@@ -79,4 +122,6 @@ public:
     const Status getRecord(const RID & rid, Record & rec);
 };
 
+static_assert(sizeof(Page) == PAGESIZE, "Page must fill exactly PAGESIZE bytes");
+
 #endif
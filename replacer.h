@@ -0,0 +1,272 @@
+/**
+* Thomas Smegal, student ID: 9083224718
+* Arjun Muralikrishnan, student ID: 9082992190
+* Omkar Kendale, student ID: 9084295774
+*
+* This header defines the page replacement policies the buffer manager can
+* use to choose which frame to evict: the clock algorithm (the default),
+* 2Q and ARC. The latter two keep a history of recently evicted pages so a
+* single sequential scan cannot push a frequently used working set out.
+*/
+#ifndef REPLACER_H
+#define REPLACER_H
+
+#include <atomic>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+#include "db.h"
+
+// replacement policies a BufMgr can be constructed with
+enum ReplPolicy { CLOCK, TWOQ, ARC };
+
+
+// Interface between BufMgr and its replacement policy.  Only unpinned
+// frames are candidates for eviction: a frame leaves the candidate set
+// when it is loaded or hit and re-enters it when its last pin is dropped.
+// Every call about a frame except victim()/victims() is made with that frame's
+// latch held, so the calls for one frame arrive in order.
+class Replacer
+{
+public:
+  static Replacer* create(const ReplPolicy policy, const int frames);
+  virtual ~Replacer() {}
+
+  virtual const char* name() const = 0;
+
+  // a page was read into frame; the frame is pinned
+  virtual void loaded(const int frame, const File* file, const int pageNo) = 0;
+
+  // frame was hit by readPage; the frame is pinned
+  virtual void accessed(const int frame) = 0;
+
+  // the last pin on frame was dropped, so it may now be evicted.  A cold
+  // frame (a page a sequential reader is done with) is offered for
+  // eviction ahead of the others.
+  virtual void unpinned(const int frame, const bool cold = false) = 0;
+
+  // BufMgr evicted frame's page to make room for another one
+  virtual void evicted(const int frame) = 0;
+
+  // frame's page left the pool without being evicted (flush or dispose)
+  virtual void removed(const int frame) = 0;
+
+  // take an unpinned frame out of the candidate set and return it in
+  // frame.  BufMgr must then call evicted() for it, or unpinned() if it
+  // decides not to evict it after all.  Returns BUFFEREXCEEDED at once if
+  // every frame is pinned.
+  virtual const Status victim(int& frame) = 0;
+
+  // take up to max frames out of the candidate set at once, as max calls
+  // of victim() would, and return how many were taken (0 if every frame
+  // is pinned).  Each must be handed back the same way as after victim().
+  virtual int victims(int* frames, const int max);
+
+  // frames looked at by victim() and victims() so far, taken or passed
+  // over: the length of the clock's sweeps, one per frame taken for the
+  // list-based policies (always 0 when built with NOBUFSTATS)
+  virtual unsigned long swept() const = 0;
+
+  // fill frames with up to max candidates, those victim() would hand out
+  // first coming first, without taking them; returns how many were found.
+  // The answer is only a hint, since frames may be pinned at any moment.
+  virtual int upcoming(int* frames, const int max) = 0;
+
+  // fill frames with up to max frames, the ones the policy would keep
+  // longest first, pinned frames included: roughly the reverse of the
+  // eviction order.  Frames holding no page may be listed; the caller
+  // skips them.  Returns how many were filled in.
+  virtual int hottest(int* frames, const int max) = 0;
+
+  // the pool now has frames frames.  Made while no other call is; when
+  // the pool shrinks, the frames it loses hold no page.
+  virtual void resize(const int frames) = 0;
+};
+
+
+// The clock algorithm.  Reference and candidate bits are atomics, so hits
+// and unpins never take a lock; victim() sweeps the hand over candidate
+// frames, giving referenced ones a second chance.
+class ClockReplacer : public Replacer
+{
+private:
+  int numFrames;
+  std::atomic<unsigned int> clockHand;
+  std::atomic<bool>* refbit;     // has this frame been referenced recently
+  std::atomic<bool>* evictable;  // unpinned and in the candidate set
+  std::atomic<int>   numEvictable;
+  ShardedCounters<1> steps;      // frames the hand has passed in victim()
+
+  void take(const int frame)   // drop frame from the candidate set
+  {
+    if (evictable[frame].exchange(false))
+      numEvictable--;
+  }
+
+public:
+  ClockReplacer(const int frames);
+  ~ClockReplacer();
+
+  const char* name() const { return "clock"; }
+  void loaded(const int frame, const File* file, const int pageNo);
+  void accessed(const int frame);
+  void unpinned(const int frame, const bool cold = false);
+  void evicted(const int frame);
+  void removed(const int frame);
+  const Status victim(int& frame);
+  unsigned long swept() const { return steps.sum(0); }
+  int upcoming(int* frames, const int max);
+  int hottest(int* frames, const int max);
+  void resize(const int frames);
+};
+
+
+// identity of a page, used to remember pages that have been evicted
+struct PageKey
+{
+  const File* file;
+  int         pageNo;
+
+  bool operator == (const PageKey& other) const
+    {
+      return file == other.file && pageNo == other.pageNo;
+    }
+};
+
+struct PageKeyHash
+{
+  size_t operator () (const PageKey& key) const
+    {
+      return std::hash<const void*>()(key.file) ^ ((size_t)key.pageNo * 0x9e3779b97f4a7c15UL);
+    }
+};
+
+// bounded history of evicted pages ("ghost" entries), oldest first
+class GhostList
+{
+private:
+  list<PageKey> order;
+  unordered_map<PageKey, list<PageKey>::iterator, PageKeyHash> where;
+
+public:
+  int  size() const { return (int)order.size(); }
+  bool contains(const PageKey& key) const { return where.count(key) != 0; }
+  void push(const PageKey& key);    // add key as the newest entry
+  void erase(const PageKey& key);   // forget key if present
+  void popOldest();                 // forget the oldest entry
+};
+
+// Doubly linked lists of frames threaded through shared arrays, most
+// recently unpinned frame at the front.  A frame is on at most one list.
+class FrameLists
+{
+private:
+  int  numFrames;
+  int  numLists;
+  int* prev;     // numFrames + numLists entries; the last ones are list heads
+  int* next;
+  int* onList;   // list a frame is linked on, -1 if none
+  int* length;
+
+public:
+  FrameLists(const int frames, const int lists);
+  ~FrameLists();
+
+  void resize(const int frames);              // frames dropped must be unlinked
+
+  void pushFront(const int list, const int frame);
+  void pushBack(const int list, const int frame);
+  void unlink(const int frame);               // no-op if frame is not linked
+  int  back(const int list) const;            // least recent frame, -1 if empty
+  int  before(const int frame) const;         // next more recent frame, -1 at the front
+  int  front(const int list) const;           // most recent frame, -1 if empty
+  int  after(const int frame) const;          // next less recent frame, -1 at the back
+  int  size(const int list) const { return length[list]; }
+  bool linked(const int frame) const { return onList[frame] != -1; }
+};
+
+
+// Simplified 2Q (Johnson and Shasha).  Pages enter a FIFO-like probation
+// queue A1in; only a page referenced again after it was evicted from A1in
+// (found in the A1out history) is admitted to the main LRU queue Am.  A
+// scan therefore cycles through A1in and leaves Am alone.
+class TwoQReplacer : public Replacer
+{
+private:
+  enum { A1IN = 0, AM = 1 };
+
+  std::mutex lock;
+  int        numFrames;
+  int        kin;        // target size of A1in
+  int        kout;       // size of the A1out history
+  FrameLists lists;      // unpinned frames of each queue
+  int*       queue;      // queue each resident frame belongs to, -1 if empty
+  PageKey*   key;        // page held by each frame
+  int        resident[2];// resident frames per queue, pinned or not
+  GhostList  a1out;
+
+  ShardedCounters<1> steps; // frames handed out by victim()
+  void forget(const int frame);
+  bool pick(int& frame);   // victim() with the lock held
+
+public:
+  TwoQReplacer(const int frames);
+  ~TwoQReplacer();
+
+  const char* name() const { return "2q"; }
+  void loaded(const int frame, const File* file, const int pageNo);
+  void accessed(const int frame);
+  void unpinned(const int frame, const bool cold = false);
+  void evicted(const int frame);
+  void removed(const int frame);
+  const Status victim(int& frame);
+  int victims(int* frames, const int max);
+  unsigned long swept() const { return steps.sum(0); }
+  int upcoming(int* frames, const int max);
+  int hottest(int* frames, const int max);
+  void resize(const int frames);
+};
+
+
+// Adaptive Replacement Cache (Megiddo and Modha).  T1 holds pages seen
+// once recently, T2 pages seen at least twice; the ghost lists B1 and B2
+// remember what was evicted from each and move the target size of T1 (p)
+// towards whichever list would have produced the hit.
+class ARCReplacer : public Replacer
+{
+private:
+  enum { T1 = 0, T2 = 1 };
+
+  std::mutex lock;
+  int        numFrames;  // c in the paper
+  int        target;     // p in the paper, target size of T1
+  FrameLists lists;      // unpinned frames of T1 and T2
+  int*       queue;      // list each resident frame belongs to, -1 if empty
+  PageKey*   key;        // page held by each frame
+  int        resident[2];// resident frames per list, pinned or not
+  GhostList  b1;
+  GhostList  b2;
+
+  ShardedCounters<1> steps; // frames handed out by victim()
+  void forget(const int frame);
+  bool pick(int& frame);   // victim() with the lock held
+
+public:
+  ARCReplacer(const int frames);
+  ~ARCReplacer();
+
+  const char* name() const { return "arc"; }
+  void loaded(const int frame, const File* file, const int pageNo);
+  void accessed(const int frame);
+  void unpinned(const int frame, const bool cold = false);
+  void evicted(const int frame);
+  void removed(const int frame);
+  const Status victim(int& frame);
+  int victims(int* frames, const int max);
+  unsigned long swept() const { return steps.sum(0); }
+  int upcoming(int* frames, const int max);
+  int hottest(int* frames, const int max);
+  void resize(const int frames);
+};
+
+#endif
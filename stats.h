@@ -0,0 +1,156 @@
+/**
+* Thomas Smegal, student ID: 9083224718
+* Arjun Muralikrishnan, student ID: 9082992190
+* Omkar Kendale, student ID: 9084295774
+*
+* This header defines the counters and latency histograms the buffer
+* manager and files keep about their own activity. Compiling with
+* -DNOBUFSTATS turns them into empty classes whose updates vanish, so the
+* statistics cost nothing; they then read as zero.
+*/
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+using namespace std;
+
+// counters are spread over this many cache lines, one picked per thread
+const int STATSHARDS = 16;
+
+// the shard the calling thread updates
+inline int statShard()
+{
+  static std::atomic<int> nextShard(0);
+  static thread_local int shard = nextShard++ % STATSHARDS;
+  return shard;
+}
+
+#ifndef NOBUFSTATS
+
+// N 64-bit counters.  Each thread adds to its own shard with a relaxed
+// atomic add, so threads counting the same event rarely share a cache
+// line; reading a counter sums its shards.
+template <int N>
+class ShardedCounters
+{
+private:
+  struct alignas(64) Shard
+  {
+    std::atomic<unsigned long> count[N];
+  };
+  Shard shards[STATSHARDS];
+
+public:
+  ShardedCounters() { clear(); }
+
+  void add(const int counter, const unsigned long n = 1)
+    {
+      shards[statShard()].count[counter].fetch_add(n, std::memory_order_relaxed);
+    }
+  unsigned long sum(const int counter) const
+    {
+      unsigned long total = 0;
+      for (int s = 0; s < STATSHARDS; s++)
+        total += shards[s].count[counter].load(std::memory_order_relaxed);
+      return total;
+    }
+  void clear()
+    {
+      for (int s = 0; s < STATSHARDS; s++)
+        for (int i = 0; i < N; i++)
+          shards[s].count[i] = 0;
+    }
+};
+
+#define STATADD(counters, counter, n)  ((counters).add((counter), (n)))
+
+#else
+
+template <int N>
+class ShardedCounters
+{
+public:
+  void add(const int counter, const unsigned long n = 1) {}
+  unsigned long sum(const int counter) const { return 0; }
+  void clear() {}
+};
+
+#define STATADD(counters, counter, n)  ((void)0)
+
+#endif
+
+#define STATINC(counters, counter)     STATADD(counters, counter, 1)
+
+
+// number of histogram buckets; bucket b > 0 holds latencies in
+// [2^(b-1), 2^b) nanoseconds, bucket 0 zero, the last one everything above
+const int LATBUCKETS = 40;
+
+// a latency histogram as read at one moment
+struct LatencyHist
+{
+  unsigned long count[LATBUCKETS];
+  unsigned long totalNs;          // sum of all samples
+
+  LatencyHist() { clear(); }
+  void clear();
+  unsigned long samples() const;
+  unsigned long percentile(const double p) const; // upper bound of the bucket, in ns
+  LatencyHist operator - (const LatencyHist& earlier) const;
+  void print(ostream& os, const bool json) const;
+};
+
+// a histogram being filled in, by any number of threads
+class LatencyRecorder
+{
+#ifndef NOBUFSTATS
+private:
+  std::atomic<unsigned long> count[LATBUCKETS];
+  std::atomic<unsigned long> totalNs;
+
+public:
+  LatencyRecorder() { clear(); }
+  void record(const unsigned long ns);
+  void snapshot(LatencyHist& hist) const;
+  void clear();
+#else
+public:
+  void record(const unsigned long ns) {}
+  void snapshot(LatencyHist& hist) const { hist.clear(); }
+  void clear() {}
+#endif
+};
+
+// times its own lifetime into a recorder, if given one
+class IOTimer
+{
+#ifndef NOBUFSTATS
+private:
+  LatencyRecorder* recorder;
+  std::chrono::steady_clock::time_point start;
+
+public:
+  IOTimer(LatencyRecorder* r) : recorder(r), start(std::chrono::steady_clock::now()) {}
+  ~IOTimer()
+    {
+      if (recorder != NULL)
+        recorder->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+#else
+public:
+  IOTimer(LatencyRecorder* r) {}
+#endif
+};
+
+// latency of the disk reads and writes one buffer pool issues, one sample
+// per call (a vectored call moving several pages is one sample)
+struct IOStats
+{
+  LatencyRecorder reads;
+  LatencyRecorder writes;
+};
+
+#endif